@@ -19,6 +19,10 @@
 #include <math.h>
 #include <errno.h>
 
+// most consecutive moves to equally good neighbors before the hill climb gives up
+// (without a limit, it can circle a plateau forever)
+#define MAXPLATEAUSTEPS 256
+
 // precomputed NTSC-J to SRGB color gamut conversion using Bradford Method
 // Note:
 // NTSC-J television sets had a whitepoint of 9300K+27mpcd (x=0.281, y=0.311)
@@ -184,6 +188,76 @@ bool checknearbycolor(struct pixel8 input, int roffset, int goffset, int boffset
     return false;
 }
 
+/*
+ * Hill climbs to the NTSC-J color that converts to the sRGB color closest to target.
+ * Returns the best guess. If error is not NULL, sets it to the error of the best guess.
+*/
+struct pixel8 guesspixel(struct pixel8 target, float* error){
+    struct pixelf32 inputpixel = pixelfrompixel8(target);
+    struct pixelf32 linearinputpixel = pixeltolinear(inputpixel);
+    struct pixelf32 goal = RGBtoXYZ(linearinputpixel);
+    
+    // start with the target as the first guess (this should be in the right neighborhood)
+    struct pixel8 firstguess = pixel8frompixel(inputpixel);
+    struct pixelf32 firstguessoutput = processpixel8(firstguess);
+    float firsterror = distance(firstguessoutput, goal);
+    
+    float besterror = firsterror;
+    struct pixel8 bestguess = firstguess;
+    int lasti = 0;
+    int lastj = 0;
+    int lastk = 0;
+    int plateausteps = 0;
+    
+    // hill climb to the input that converts to sRGB color closest to goal
+    while (true){
+        
+        bool foundbetterguess = false;
+        float lasterror = besterror;
+        struct pixel8 thisguess = bestguess;
+        int thisi = 0;
+        int thisj = 0;
+        int thisk = 0;
+        
+        // test increments of +/-1 on all axes (26 directions)
+        for (int i = -1; i<=1; i++){
+            for (int j = -1; j<=1; j++){
+                for (int k = -1; k<=1; k++){
+                    // skip the input color
+                    if ((i == 0) && (j == 0) && (k == 0)) continue;
+                    // don't go back to where we just came from
+                    if ((i == lasti) && (j == lastj) && (k == lastk)) continue;
+                    if(checknearbycolor(thisguess, i, j, k, goal, &besterror, &bestguess, &thisi, &thisj, &thisk)){
+                        foundbetterguess = true;
+                    }
+                }
+            }
+        }
+        // save out the reverse of the direction we just moved
+        lasti = thisi;
+        lastj = thisj;
+        lastk = thisk;
+        
+        if (!foundbetterguess) break;
+        
+        // moving sideways doesn't count as progress
+        if (besterror < lasterror){
+            plateausteps = 0;
+        }
+        else {
+            plateausteps++;
+            if (plateausteps >= MAXPLATEAUSTEPS) break;
+        }
+        
+    } // end of while true
+    
+    if (error != NULL) *error = besterror;
+    return bestguess;
+}
+
+// ntscjguessmodule.c includes this file and supplies its own entry points
+#ifndef NTSCJGUESS_NO_MAIN
+
 int main(int argc, const char **argv){
     
     int output = 1; // wrong arg count
@@ -207,55 +281,10 @@ int main(int argc, const char **argv){
             inputok = false;
         }
         if (inputok){
-            struct pixelf32 inputpixel = pixelfromint(input);
-            struct pixelf32 linearinputpixel = pixeltolinear(inputpixel);
-            struct pixelf32 goal = RGBtoXYZ(linearinputpixel);
-            
-            // start with the target as the first guess (this should be in the right neighborhood)
-            struct pixel8 firstguess = pixel8frompixel(inputpixel);
-            struct pixelf32 firstguessoutput = processpixel8(firstguess);
-            float firsterror = distance(firstguessoutput, goal);
-            
-            float besterror = firsterror;
-            struct pixel8 bestguess = firstguess;
-            int lasti = 0;
-            int lastj = 0;
-            int lastk = 0;
-            
-            // hill climb to the input that converts to sRGB color closest to goal
-            while (true){
-                
-                bool foundbetterguess = false;
-                struct pixel8 thisguess = bestguess;
-                int thisi = 0;
-                int thisj = 0;
-                int thisk = 0;
-                
-                // test increments of +/-1 on all axes (14 directions)
-                for (int i = -1; i<=1; i++){
-                    for (int j = -1; j<=1; j++){
-                        for (int k = -1; k<=1; k++){
-                            // skip the input color
-                            if ((i == 0) && (j == 0) && (k == 0)) continue;
-                            // don't go back to where we just came from
-                            if ((i == lasti) && (j == lastj) && (k == lastk)) continue;
-                            if(checknearbycolor(thisguess, i, j, k, goal, &besterror, &bestguess, &thisi, &thisj, &thisk)){
-                                foundbetterguess = true;
-                            }
-                        }
-                    }
-                }
-                // save out the reverse of the direction we just moved
-                lasti = thisi;
-                lastj = thisj;
-                lastk = thisk;
-                
-                if (!foundbetterguess){
-                    printf("To achieve sRGB output of 0x%06X use NTSC-J input of 0x%02X%02X%02X (red: %i, green: %i, blue: %i, error %f).\n", input, bestguess.red, bestguess.green, bestguess.blue, bestguess.red, bestguess.green, bestguess.blue, besterror);
-                    break;
-                }
-                
-            } // end of while true
+            struct pixel8 target = {input >> 16, (input & 0x0000FF00) >> 8, input & 0x000000FF};
+            float besterror;
+            struct pixel8 bestguess = guesspixel(target, &besterror);
+            printf("To achieve sRGB output of 0x%06X use NTSC-J input of 0x%02X%02X%02X (red: %i, green: %i, blue: %i, error %f).\n", input, bestguess.red, bestguess.green, bestguess.blue, bestguess.red, bestguess.green, bestguess.blue, besterror);
             
             output = 0; // all good
         } // end if inputok
@@ -267,3 +296,5 @@ int main(int argc, const char **argv){
     
     return output;
 }
+
+#endif // NTSCJGUESS_NO_MAIN
@@ -0,0 +1,254 @@
+/*- ntscjguess Python module
+ *
+ * COPYRIGHT: 2023 by Chris Bussard
+ * LICENSE: GPLv3
+ *
+ * CPython extension exposing ntscjguess to scripts.
+ * ntscjguess.convert(src, dst=None, threads=0) takes any buffer of uint8 with
+ * a last dimension of 3 (e.g. a NumPy image or palette array, strided views included)
+ * or of packed RGB8, finds the NTSC-J color for every sRGB pixel, and writes the
+ * results into dst in place. If dst is omitted, a new bytearray is returned.
+ * src and dst may be the same buffer or overlap; src is read in full before dst is written.
+ * The GIL is released while the pixels are processed.
+ *
+ * To build on Linux:
+ * gcc -O2 -shared -fPIC -fvisibility=hidden $(python3-config --includes) -o ntscjguess$(python3-config --extension-suffix) ntscjguessmodule.c -lm -lpthread
+ * (-fvisibility=hidden keeps the solver functions from ntscjguess.c out of the exported symbols.)
+ *
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define NTSCJGUESS_NO_MAIN
+#include "ntscjguess.c"
+
+// most threads convert() will start, no matter how many are asked for
+#define MAXTHREADS 256
+
+struct convertjob {
+    const unsigned char* src;
+    unsigned char* dst;
+    Py_ssize_t count; // in pixels
+};
+
+// convert a run of packed RGB8 pixels
+static void* convertrun(void* arg){
+    struct convertjob* job = (struct convertjob*)arg;
+    for (Py_ssize_t i = 0; i < job->count; i++){
+        const unsigned char* in = job->src + (i * 3);
+        unsigned char* out = job->dst + (i * 3);
+        // read the whole pixel before writing in case src and dst are the same buffer
+        struct pixel8 target = {in[0], in[1], in[2]};
+        struct pixel8 result = guesspixel(target, NULL);
+        out[0] = result.red;
+        out[1] = result.green;
+        out[2] = result.blue;
+    }
+    return NULL;
+}
+
+// split pixels into runs and convert them on up to threadcount threads
+static void convertpixels(const unsigned char* src, unsigned char* dst, Py_ssize_t count, int threadcount){
+    if (threadcount > count) threadcount = (int)count;
+    if (threadcount < 1) threadcount = 1;
+
+    pthread_t threads[MAXTHREADS];
+    bool started[MAXTHREADS];
+    struct convertjob jobs[MAXTHREADS];
+
+    Py_ssize_t perthread = count / threadcount;
+    Py_ssize_t leftover = count % threadcount;
+    Py_ssize_t offset = 0;
+    for (int i = 0; i < threadcount; i++){
+        jobs[i].count = perthread + ((i < leftover) ? 1 : 0);
+        jobs[i].src = src + (offset * 3);
+        jobs[i].dst = dst + (offset * 3);
+        offset += jobs[i].count;
+    }
+
+    // run the first job on this thread; if a thread won't start, run its job here too
+    for (int i = 1; i < threadcount; i++){
+        started[i] = (pthread_create(&threads[i], NULL, convertrun, &jobs[i]) == 0);
+    }
+    convertrun(&jobs[0]);
+    for (int i = 1; i < threadcount; i++){
+        if (started[i]){
+            pthread_join(threads[i], NULL);
+        }
+        else {
+            convertrun(&jobs[i]);
+        }
+    }
+}
+
+/*
+ * Checks that view is a buffer of uint8 whose last dimension is 3,
+ * or a flat buffer of packed RGB8 pixels (e.g. bytes or bytearray).
+ * Returns true if so; else sets a Python exception and returns false.
+*/
+static bool checkrgb8buffer(Py_buffer* view, const char* name){
+    const char* format = view->format;
+    // byte order prefixes don't matter for single bytes
+    if ((format != NULL) && (format[0] != '\0') && (strchr("@=<>!", format[0]) != NULL)){
+        format++;
+    }
+    if ((view->itemsize != 1) || ((format != NULL) && (strcmp(format, "B") != 0))){
+        PyErr_Format(PyExc_TypeError, "%s must be a buffer of uint8", name);
+        return false;
+    }
+    bool shapeok;
+    if (view->ndim == 1){
+        shapeok = ((view->shape[0] % 3) == 0);
+    }
+    else {
+        shapeok = ((view->ndim > 1) && (view->shape[view->ndim - 1] == 3));
+    }
+    if (!shapeok){
+        PyErr_Format(PyExc_ValueError, "%s must have a last dimension of 3", name);
+        return false;
+    }
+    return true;
+}
+
+PyDoc_STRVAR(convert_doc,
+"convert(src, dst=None, threads=0)\n"
+"\n"
+"For every sRGB pixel in src, find the NTSC-J pixel that converts to it and write it to dst.\n"
+"src and dst must be uint8 buffers of shape (..., 3), or flat buffers of packed RGB8,\n"
+"with the same number of pixels. Strided (non-contiguous) buffers are allowed.\n"
+"src and dst may be the same buffer or overlap; src is read in full before dst is written.\n"
+"If dst is None, a new bytearray is returned instead.\n"
+"threads is the number of worker threads to use; 0 means one per online CPU.");
+
+static PyObject* ntscjguess_convert(PyObject* self, PyObject* args, PyObject* kwargs){
+    (void)self;
+    static char* kwlist[] = {"src", "dst", "threads", NULL};
+    PyObject* srcobj;
+    PyObject* dstobj = Py_None;
+    int threadcount = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|Oi:convert", kwlist, &srcobj, &dstobj, &threadcount)){
+        return NULL;
+    }
+    if (threadcount < 0){
+        PyErr_SetString(PyExc_ValueError, "threads must not be negative");
+        return NULL;
+    }
+    if (threadcount == 0){
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threadcount = (cpus > 0) ? (int)cpus : 1;
+    }
+    if (threadcount > MAXTHREADS) threadcount = MAXTHREADS;
+
+    Py_buffer src;
+    if (PyObject_GetBuffer(srcobj, &src, PyBUF_RECORDS_RO) != 0){
+        return NULL;
+    }
+    if (!checkrgb8buffer(&src, "src")){
+        PyBuffer_Release(&src);
+        return NULL;
+    }
+
+    PyObject* result;
+    if (dstobj == Py_None){
+        result = PyByteArray_FromStringAndSize(NULL, src.len);
+        if (result == NULL){
+            PyBuffer_Release(&src);
+            return NULL;
+        }
+        dstobj = result;
+    }
+    else {
+        Py_INCREF(dstobj);
+        result = dstobj;
+    }
+
+    Py_buffer dst;
+    if (PyObject_GetBuffer(dstobj, &dst, PyBUF_RECORDS) != 0){
+        PyBuffer_Release(&src);
+        Py_DECREF(result);
+        return NULL;
+    }
+    if (!checkrgb8buffer(&dst, "dst")){
+        PyBuffer_Release(&dst);
+        PyBuffer_Release(&src);
+        Py_DECREF(result);
+        return NULL;
+    }
+    if (dst.len != src.len){
+        PyErr_SetString(PyExc_ValueError, "src and dst must be the same size");
+        PyBuffer_Release(&dst);
+        PyBuffer_Release(&src);
+        Py_DECREF(result);
+        return NULL;
+    }
+
+    // convert directly only if both buffers are contiguous and either identical or disjoint;
+    // otherwise gather src into a packed copy, convert that, and scatter it into dst
+    const unsigned char* srcbytes = (const unsigned char*)src.buf;
+    unsigned char* dstbytes = (unsigned char*)dst.buf;
+    bool direct = PyBuffer_IsContiguous(&src, 'C') && PyBuffer_IsContiguous(&dst, 'C');
+    if (direct && (srcbytes != dstbytes)){
+        bool overlap = (srcbytes < dstbytes + dst.len) && (dstbytes < srcbytes + src.len);
+        direct = !overlap;
+    }
+
+    unsigned char* scratch = NULL;
+    if (!direct){
+        // +1 so an empty buffer still gets a valid allocation
+        scratch = (unsigned char*)PyMem_Malloc(src.len + 1);
+        if (scratch == NULL){
+            PyErr_NoMemory();
+            PyBuffer_Release(&dst);
+            PyBuffer_Release(&src);
+            Py_DECREF(result);
+            return NULL;
+        }
+        if (PyBuffer_ToContiguous(scratch, &src, src.len, 'C') != 0){
+            PyMem_Free(scratch);
+            PyBuffer_Release(&dst);
+            PyBuffer_Release(&src);
+            Py_DECREF(result);
+            return NULL;
+        }
+        srcbytes = scratch;
+        dstbytes = scratch;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    convertpixels(srcbytes, dstbytes, src.len / 3, threadcount);
+    Py_END_ALLOW_THREADS
+
+    int status = 0;
+    if (!direct){
+        status = PyBuffer_FromContiguous(&dst, scratch, dst.len, 'C');
+        PyMem_Free(scratch);
+    }
+
+    PyBuffer_Release(&dst);
+    PyBuffer_Release(&src);
+    if (status != 0){
+        Py_DECREF(result);
+        return NULL;
+    }
+    return result;
+}
+
+static PyMethodDef ntscjguess_methods[] = {
+    {"convert", (PyCFunction)(void(*)(void))ntscjguess_convert, METH_VARARGS | METH_KEYWORDS, convert_doc},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef ntscjguess_module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "ntscjguess",
+    .m_doc = "Finds the NTSC-J colors that convert to given sRGB colors.",
+    .m_size = -1,
+    .m_methods = ntscjguess_methods,
+};
+
+PyMODINIT_FUNC PyInit_ntscjguess(void){
+    return PyModule_Create(&ntscjguess_module);
+}
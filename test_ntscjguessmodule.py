@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""Smoke test for the ntscjguess Python module.
+
+Build the CLI and the module first (see README.md), then run from the repo directory:
+    python3 test_ntscjguessmodule.py [path/to/ntscjguess]
+
+Checks the module against the CLI, in-place and overlapping conversion,
+strided buffers, and the error paths. Exits nonzero on the first failure.
+"""
+
+import random
+import subprocess
+import sys
+
+import ntscjguess
+
+CLI = sys.argv[1] if len(sys.argv) > 1 else "./ntscjguess"
+
+
+def cliguess(color):
+    out = subprocess.run([CLI, "0x%06X" % color], capture_output=True, text=True, timeout=10, check=True).stdout
+    return bytes.fromhex(out.split("NTSC-J input of 0x")[1][:6])
+
+
+def packed(colors):
+    return b"".join(c.to_bytes(3, "big") for c in colors)
+
+
+def expecterror(kind, fn):
+    try:
+        fn()
+    except kind:
+        return
+    raise AssertionError("expected %s" % kind.__name__)
+
+
+# known answer
+assert bytes(ntscjguess.convert(b"\x20\x30\x4f")) == bytes.fromhex("262D4D")
+
+# agrees with the CLI, including a color that used to hang the hill climb
+random.seed(76)
+colors = [0x000000, 0xFFFFFF, 0x20304F, 0xB05800, 0x00FF00, 0xF21B10]
+colors += [random.randrange(0x1000000) for _ in range(100)]
+data = packed(colors)
+expected = b"".join(cliguess(c) for c in colors)
+assert bytes(ntscjguess.convert(data)) == expected
+assert bytes(ntscjguess.convert(data, threads=1)) == expected
+assert bytes(ntscjguess.convert(data, threads=4)) == expected
+
+# dst is src
+buf = bytearray(data)
+assert ntscjguess.convert(buf, buf) is buf
+assert bytes(buf) == expected
+
+# partly overlapping src and dst, both directions
+for threads in (1, 4):
+    buf = bytearray(data + bytes(3))
+    view = memoryview(buf)
+    ntscjguess.convert(view[:-3], view[3:], threads=threads)
+    assert bytes(buf[3:]) == expected
+    buf = bytearray(bytes(3) + data)
+    view = memoryview(buf)
+    ntscjguess.convert(view[3:], view[:-3], threads=threads)
+    assert bytes(buf[:-3]) == expected
+
+# strided src and dst: every other row of a (2n, 1, 3) image
+rows = bytearray()
+for i in range(len(colors)):
+    rows += data[i * 3:(i + 1) * 3] + b"\xff\xff\xff"
+image = memoryview(rows).cast("B", (len(colors) * 2, 1, 3))
+assert bytes(ntscjguess.convert(image[::2])) == expected
+target = bytearray(len(rows))
+ntscjguess.convert(image[::2], memoryview(target).cast("B", (len(colors) * 2, 1, 3))[1::2])
+assert b"".join(target[i * 6 + 3:i * 6 + 6] for i in range(len(colors))) == expected
+assert not any(b"".join(target[i * 6:i * 6 + 3] for i in range(len(colors))))
+
+# error paths
+expecterror(TypeError, lambda: ntscjguess.convert(memoryview(bytearray(24)).cast("i", (2, 3))))
+expecterror(ValueError, lambda: ntscjguess.convert(b"ab"))
+expecterror(ValueError, lambda: ntscjguess.convert(memoryview(bytearray(8)).cast("B", (2, 4))))
+expecterror(BufferError, lambda: ntscjguess.convert(data, bytes(len(data))))
+expecterror(ValueError, lambda: ntscjguess.convert(data, bytearray(3)))
+expecterror(ValueError, lambda: ntscjguess.convert(data, threads=-1))
+
+assert len(ntscjguess.convert(b"")) == 0
+
+print("ok")